@@ -1,9 +1,19 @@
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <string>
 #include <thread>
 #include <unordered_set>
 #include <vector>
@@ -14,9 +24,14 @@ using namespace std;
 
 static const bool DEF_SHOW_PROGRESS = false;
 static const bool DEF_WAIT_KEY = false;
-static const int DEF_SLEEP_MS = 100;
+static const int DEF_FRAME_MS = 33;
+static const long long DEF_TIMEOUT_MS = 0;  // 0 means no deadline.
+static const long long DEF_MAX_NODES = 0;   // 0 means no limit.
 
-static chrono::milliseconds sleeps = chrono::milliseconds(DEF_SLEEP_MS);
+// Check the wall clock once per this many recursion nodes.
+static const long long CLOCK_CHECK_INTERVAL = 1024;
+
+static chrono::milliseconds frame_interval = chrono::milliseconds(DEF_FRAME_MS);
 
 // Up to 64 bit.
 typedef unsigned long long BitMask;
@@ -31,17 +46,48 @@ struct Segment {
     int max_shift;
 };
 
+enum class SolveStatus {
+    kSolved,
+    kFailed,
+    kTimedOut,  // Budget ran out. The grid is partially decided.
+    kCancelled,  // Stopped by Cancel(). The grid is partially decided.
+};
+
 class Nono {
 public:
     explicit Nono(vector<vector<int>>& rows, vector<vector<int>>& cols);
-    bool Solve();
+    SolveStatus Solve();
     void Show();
+    // Check the solved grid against the row and column values.
+    bool Verify();
+    // Write rows as hex numbers. The most significant bit is column 1.
+    // Undecided points are written as empty, so use only for a solution.
+    void WritePacked(FILE* fp);
+    // Write the grid as a binary PBM (P4) image.
+    void WritePbm(FILE* fp);
     void SetOption(bool show_progress, bool wait_key);
+    // Stop solving when timeout_ms or max_nodes is exceeded.
+    // 0 disables the corresponding limit.
+    void SetBudget(long long timeout_ms, long long max_nodes);
+    // Request the running Solve() to stop. Can be called from another
+    // thread or a signal handler. Each Solve() starts uncancelled.
+    // Noticed at the next budget check, or at the next line run
+    // when neither limit is set.
+    void Cancel();
+
+    int GetLineRuns() const { return line_runs_; }
+    long long GetNodes() const { return nodes_; }
 
 private:
     // Options
     bool show_progress_ = DEF_SHOW_PROGRESS;
     bool wait_key_ = DEF_WAIT_KEY;
+    long long timeout_ms_ = DEF_TIMEOUT_MS;
+    long long max_nodes_ = DEF_MAX_NODES;
+
+    // Draws progress on its own thread unless wait_key_ is set.
+    class Renderer;
+    unique_ptr<Renderer> renderer_;
 
     // pos_masks_[n] = 1 << n
     BitMask pos_masks_[64];
@@ -68,11 +114,23 @@ private:
     // Temporary mask for processing a row or a column.
     BitMask common_omask_, common_xmask_;
 
-    int line_runs_;
+    int line_runs_ = 0;
+
+    // Budget state. nodes_ counts MoveSegment() calls.
+    // CheckBudget() is called only when nodes_ reaches next_check_.
+    long long nodes_ = 0;
+    long long next_check_ = LLONG_MAX;
+    chrono::steady_clock::time_point deadline_;
+    atomic<bool> cancelled_{false};
+    // Set when out of budget or cancelled. stop_status_ tells which.
+    bool stopped_ = false;
+    SolveStatus stop_status_ = SolveStatus::kTimedOut;
 
     void PrepareLine(vector<Segment>& dst, vector<int>& src, int limit, int* sum);
     BitMask LenToBitMask(int len);
 
+    SolveStatus SolveInternal(const char** message);
+
 #ifdef USE_HEURISTIC_INIT
     void MarkOverlaps();
     void MarkO(int row, int col);
@@ -82,6 +140,11 @@ private:
     bool MoveSegment(vector<Segment>& segments, BitMask omask, BitMask xmask, int idx, int shift_start, int limit, BitMask covered, BitMask uncovered);
     BitMask UpdateResult(BitMask result, int idx, vector<BitMask>& lines, vector<BitMask>& crosses);
 
+    bool CheckBudget();
+    long long NextCheck();
+
+    bool MatchRuns(BitMask line, vector<Segment>& segments);
+
     bool IsRowFinished(int row);
     bool IsColFinished(int col);
 
@@ -92,6 +155,57 @@ private:
     static char o_, x_, u_;
 };
 
+// Snapshot of the grid passed from the solver to the renderer.
+struct Snapshot {
+    vector<BitMask> omasks;  // Per row
+    vector<BitMask> xmasks;  // Per row
+    int row;
+    int col;
+};
+
+// Redraws the latest snapshot at a fixed frame rate.
+// The solver and the renderer share a lock-free triple buffer:
+// Publish() never blocks and older unread snapshots are dropped.
+// Only the cells changed since the last frame are repainted
+// with ANSI cursor positioning.
+class Nono::Renderer {
+public:
+    Renderer(int num_row, int num_col);
+    ~Renderer();
+    void Start();
+    void Stop();
+
+    // Buffer owned by the solver thread. Fill it and call Publish().
+    Snapshot& Back() { return buffers_[back_]; }
+    void Publish();
+
+private:
+    // Set on middle_ when it holds a snapshot not read yet.
+    static const int FRESH = 4;
+
+    int num_row_, num_col_;
+    Snapshot buffers_[3];
+    int back_ = 0;  // Solver thread only.
+    int front_ = 1;  // Renderer thread only.
+    atomic<int> middle_{2};
+
+    // Stop() wakes the thread through stop_cv_ without waiting for a frame.
+    mutex mutex_;
+    condition_variable stop_cv_;
+    bool running_ = false;
+    thread thread_;
+
+    // Symbols currently on the screen. Empty before the first frame.
+    vector<char> screen_;
+    string out_;
+
+    void Loop();
+    bool Fetch();
+    void Draw(const Snapshot& snap);
+    void DrawHeader(const Snapshot& snap);
+    void MoveTo(int line, int column);
+};
+
 char Nono::o_ = '@';
 char Nono::x_ = '=';
 char Nono::u_ = '.';
@@ -167,10 +281,45 @@ BitMask Nono::LenToBitMask(int len)
     return mask;
 }
 
-bool Nono::Solve()
+SolveStatus Nono::Solve()
+{
+    if (show_progress_ && !wait_key_) {
+        renderer_.reset(new Renderer(num_row_, num_col_));
+        renderer_->Start();
+    }
+    const char* message = nullptr;
+    auto status = SolveInternal(&message);
+    // Print after the renderer releases the screen.
+    if (renderer_) {
+        renderer_->Stop();
+        renderer_.reset();
+    }
+    if (message != nullptr) {
+        printf("%s\n", message);
+    }
+    if (status != SolveStatus::kFailed) {
+        printf("Total line runs: %d, nodes: %lld\n", line_runs_, nodes_);
+    }
+    return status;
+}
+
+// Sets message to the reason unless solved.
+SolveStatus Nono::SolveInternal(const char** message)
 {
     line_runs_ = 0;
- 
+    nodes_ = 0;
+    // Clamp the deadline not to overflow the clock.
+    auto now = chrono::steady_clock::now();
+    auto room = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::time_point::max() - now);
+    if (timeout_ms_ < room.count()) {
+        deadline_ = now + chrono::milliseconds(timeout_ms_);
+    } else {
+        deadline_ = chrono::steady_clock::time_point::max();
+    }
+    stopped_ = false;
+    cancelled_.store(false, memory_order_relaxed);
+    next_check_ = NextCheck();
+
 #ifdef USE_HEURISTIC_INIT
     MarkOverlaps();
 
@@ -199,9 +348,15 @@ bool Nono::Solve()
             }
             common_omask_ = full_row_;  // Updated in RunLine()
             common_xmask_ = full_row_;  // Updated in RunLine()
-            if (!RunLine(segments_row_[row], omasks_row_[row], xmasks_row_[row], num_col_)) {
-                printf("Cannot solve this problem 1\n");
-                return false;
+            auto solvable = RunLine(segments_row_[row], omasks_row_[row], xmasks_row_[row], num_col_);
+            if (stopped_) {
+                // The line result is incomplete. Drop it.
+                finished = false;
+                break;
+            }
+            if (!solvable) {
+                *message = "Cannot solve this problem 1";
+                return SolveStatus::kFailed;
             }
             auto changed = UpdateResult(common_omask_, row, omasks_row_, omasks_col_)
                 | UpdateResult(common_xmask_, row, xmasks_row_, xmasks_col_);
@@ -212,6 +367,7 @@ bool Nono::Solve()
             finished = finished && IsRowFinished(row);
             changed_row ^= pos_masks_[row];  // Clear bit for this row.
         }
+        if (stopped_) break;
         for (auto col = 0; col < num_col_; col++) {
             if (!(changed_col & pos_masks_[col])) {
                 // No need to update unchanged column.
@@ -220,9 +376,15 @@ bool Nono::Solve()
             }
             common_omask_ = full_col_;  // Updated in RunLine()
             common_xmask_ = full_col_;  // Updated in RunLine()
-            if (!RunLine(segments_col_[col], omasks_col_[col], xmasks_col_[col], num_row_)) {
-                printf("Cannot solve this problem 2\n");
-                return false;
+            auto solvable = RunLine(segments_col_[col], omasks_col_[col], xmasks_col_[col], num_row_);
+            if (stopped_) {
+                // The line result is incomplete. Drop it.
+                finished = false;
+                break;
+            }
+            if (!solvable) {
+                *message = "Cannot solve this problem 2";
+                return SolveStatus::kFailed;
             }
             auto changed = UpdateResult(common_omask_, col, omasks_col_, omasks_row_)
                 | UpdateResult(common_xmask_, col, xmasks_col_, xmasks_row_);
@@ -233,14 +395,57 @@ bool Nono::Solve()
             finished = finished && IsColFinished(col);
             changed_col ^= pos_masks_[col];  // Clear bit for this column.
         }
+        if (stopped_) break;
         if (!changed_row && !changed_col && !finished) {
-            printf("No changed line left\n");
-            return false;
+            *message = "No changed line left";
+            return SolveStatus::kFailed;
         }
     } while (!finished);
 
-    printf("Total line runs: %d\n", line_runs_);
-    return true;
+    if (!finished) {
+        *message = stop_status_ == SolveStatus::kCancelled ? "Cancelled" : "Out of budget";
+        return stop_status_;
+    }
+    return SolveStatus::kSolved;
+}
+
+// Check the budget when nodes_ reaches next_check_.
+// Once out of budget, keeps returning true for every later node.
+bool Nono::CheckBudget()
+{
+    if (!stopped_) {
+        stop_status_ = SolveStatus::kTimedOut;
+        if (cancelled_.load(memory_order_relaxed)) {
+            stopped_ = true;
+            stop_status_ = SolveStatus::kCancelled;
+        } else if (max_nodes_ > 0 && nodes_ >= max_nodes_) {
+            stopped_ = true;
+        } else if (timeout_ms_ > 0 && nodes_ >= next_check_) {
+            stopped_ = chrono::steady_clock::now() >= deadline_;
+        }
+    }
+    if (stopped_) {
+        next_check_ = 0;
+        return true;
+    }
+    if (nodes_ >= next_check_) {
+        next_check_ = NextCheck();
+    }
+    return false;
+}
+
+// The node count of the next budget check.
+// The wall clock is read once per CLOCK_CHECK_INTERVAL nodes.
+long long Nono::NextCheck()
+{
+    long long next = LLONG_MAX;
+    if (timeout_ms_ > 0) {
+        next = nodes_ + CLOCK_CHECK_INTERVAL;
+    }
+    if (max_nodes_ > 0) {
+        next = min(next, max_nodes_);
+    }
+    return next;
 }
 
 #ifdef USE_HEURISTIC_INIT
@@ -299,6 +504,9 @@ void Nono::MarkX(int row, int col)
 bool Nono::RunLine(vector<Segment>& segments, BitMask omask, BitMask xmask, int limit)
 {
     line_runs_++;
+    if (CheckBudget()) {
+        return false;
+    }
     if (segments.empty()) {
         common_omask_ = 0;
         return true;
@@ -311,6 +519,9 @@ bool Nono::RunLine(vector<Segment>& segments, BitMask omask, BitMask xmask, int
 // Recursion. O(limit^segments.size())
 bool Nono::MoveSegment(vector<Segment>& segments, BitMask omask, BitMask xmask, int idx, int shift_start, int limit, BitMask covered, BitMask uncovered)
 {
+    if (++nodes_ >= next_check_ && CheckBudget()) {
+        return false;
+    }
     if (idx == segments.size()) {
         for (auto i = max(shift_start - 1, 0); i < limit; i++) {
             uncovered |= pos_masks_[i];
@@ -371,6 +582,53 @@ BitMask Nono::UpdateResult(BitMask result, int idx, vector<BitMask>& lines, vect
     return changed;
 }
 
+bool Nono::Verify()
+{
+    for (auto row = 0; row < num_row_; row++) {
+        if (!IsRowFinished(row) || (omasks_row_[row] & xmasks_row_[row])) {
+            return false;
+        }
+        if (!MatchRuns(omasks_row_[row], segments_row_[row])) {
+            return false;
+        }
+    }
+    // Rebuild the columns from the rows instead of trusting omasks_col_.
+    for (auto col = 0; col < num_col_; col++) {
+        BitMask line = 0;
+        for (auto row = 0; row < num_row_; row++) {
+            if (omasks_row_[row] & pos_masks_[col]) {
+                line |= pos_masks_[row];
+            }
+        }
+        if (line != omasks_col_[col]) {
+            return false;
+        }
+        if (!MatchRuns(line, segments_col_[col])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check the runs of filled points in the line are the segments in order.
+// Takes the lowest run at a time: adding its lowest bit carries
+// through the run, so line & ~(line + low) is the run itself.
+bool Nono::MatchRuns(BitMask line, vector<Segment>& segments)
+{
+    for (auto& segment : segments) {
+        if (line == 0) {
+            return false;  // Missing runs.
+        }
+        BitMask low = line & (~line + 1);
+        BitMask run = line & ~(line + low);
+        if (run != segment.mask * low) {  // low is 1 << shift.
+            return false;
+        }
+        line ^= run;
+    }
+    return line == 0;
+}
+
 bool Nono::IsRowFinished(int row)
 {
     return (omasks_row_[row] | xmasks_row_[row]) == full_row_;
@@ -386,9 +644,55 @@ void Nono::Show()
     ShowInternal(-1, -1);
 }
 
+// Reverse the bit order by swapping halves of each width.
+static BitMask ReverseBits(BitMask mask)
+{
+    mask = ((mask >> 1) & 0x5555555555555555ULL) | ((mask & 0x5555555555555555ULL) << 1);
+    mask = ((mask >> 2) & 0x3333333333333333ULL) | ((mask & 0x3333333333333333ULL) << 2);
+    mask = ((mask >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((mask & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    mask = ((mask >> 8) & 0x00ff00ff00ff00ffULL) | ((mask & 0x00ff00ff00ff00ffULL) << 8);
+    mask = ((mask >> 16) & 0x0000ffff0000ffffULL) | ((mask & 0x0000ffff0000ffffULL) << 16);
+    return (mask >> 32) | (mask << 32);
+}
+
+// Both compact formats put column 1 in the most significant bit
+// and pad the last digit or byte with zero bits.
+void Nono::WritePacked(FILE* fp)
+{
+    int digits = (num_col_ + 3) / 4;
+    string out = "packed " + to_string(num_row_) + " " + to_string(num_col_) + "\n";
+    char buf[20];
+    for (auto row = 0; row < num_row_; row++) {
+        BitMask packed = ReverseBits(omasks_row_[row]) >> (64 - digits * 4);
+        snprintf(buf, sizeof(buf), "%0*llx\n", digits, packed);
+        out += buf;
+    }
+    fwrite(out.data(), 1, out.size(), fp);
+}
+
+void Nono::WritePbm(FILE* fp)
+{
+    int bytes = (num_col_ + 7) / 8;
+    string out = "P4\n" + to_string(num_col_) + " " + to_string(num_row_) + "\n";
+    for (auto row = 0; row < num_row_; row++) {
+        BitMask packed = ReverseBits(omasks_row_[row]);
+        for (auto i = 0; i < bytes; i++) {
+            out += static_cast<char>(packed >> (56 - i * 8));
+        }
+    }
+    fwrite(out.data(), 1, out.size(), fp);
+}
+
 void Nono::ShowProgress(int row, int col)
 {
-    if (show_progress_) {
+    if (renderer_) {
+        auto& snap = renderer_->Back();
+        snap.omasks = omasks_row_;
+        snap.xmasks = xmasks_row_;
+        snap.row = row;
+        snap.col = col;
+        renderer_->Publish();
+    } else if (show_progress_) {
         ShowInternal(row, col);
     }
 }
@@ -455,8 +759,6 @@ void Nono::ShowInternal(int row, int col)
     if (wait_key_) {
         char bb[16];
         fgets(bb, 16, stdin);
-    } else {
-        this_thread::sleep_for(sleeps);
     }
 }
 
@@ -476,24 +778,256 @@ void Nono::SetOption(bool show_progress, bool wait_key)
     wait_key_ = wait_key;
 }
 
+Nono::Renderer::Renderer(int num_row, int num_col)
+    : num_row_(num_row), num_col_(num_col)
+{
+    for (auto& snap : buffers_) {
+        snap.omasks = vector<BitMask>(num_row_, 0);
+        snap.xmasks = vector<BitMask>(num_row_, 0);
+        snap.row = -1;
+        snap.col = -1;
+    }
+}
+
+Nono::Renderer::~Renderer()
+{
+    Stop();
+}
+
+void Nono::Renderer::Start()
+{
+    running_ = true;
+    thread_ = thread(&Renderer::Loop, this);
+}
+
+// Draw the last published snapshot and wait for the thread.
+void Nono::Renderer::Stop()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        running_ = false;
+    }
+    stop_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Nono::Renderer::Publish()
+{
+    back_ = middle_.exchange(back_ | FRESH, memory_order_acq_rel) & ~FRESH;
+}
+
+// Take the latest snapshot into front_ if there is a new one.
+bool Nono::Renderer::Fetch()
+{
+    if (!(middle_.load(memory_order_relaxed) & FRESH)) {
+        return false;
+    }
+    front_ = middle_.exchange(front_, memory_order_acq_rel) & ~FRESH;
+    return true;
+}
+
+void Nono::Renderer::Loop()
+{
+    for (;;) {
+        // Read running_ before Fetch() not to miss the last snapshot.
+        bool running;
+        {
+            lock_guard<mutex> lock(mutex_);
+            running = running_;
+        }
+        if (Fetch()) {
+            Draw(buffers_[front_]);
+        }
+        if (!running) {
+            break;
+        }
+        unique_lock<mutex> lock(mutex_);
+        stop_cv_.wait_for(lock, frame_interval, [this] { return !running_; });
+    }
+    if (!screen_.empty()) {
+        // Leave the cursor below the grid.
+        MoveTo(num_row_ + 4, 1);
+        fputs(out_.c_str(), stdout);
+        fflush(stdout);
+        out_.clear();
+    }
+}
+
+void Nono::Renderer::Draw(const Snapshot& snap)
+{
+    auto first = screen_.empty();
+    if (first) {
+        screen_ = vector<char>(num_row_ * num_col_, 0);
+        // Clear the screen and draw the frame.
+        out_ += "\x1b[2J";
+        MoveTo(2, 1);
+        for (auto c = 0; c < num_col_ + 2; c++) {
+            out_ += c % 5 == 0 ? "+ " : "- ";
+        }
+        for (auto r = 0; r < num_row_; r++) {
+            MoveTo(r + 3, 1);
+            out_ += r % 5 == 4 ? '+' : '|';
+            MoveTo(r + 3, num_col_ * 2 + 3);
+            out_ += r % 5 == 4 ? '+' : '|';
+        }
+        MoveTo(num_row_ + 3, 1);
+        for (auto c = 0; c < num_col_ + 2; c++) {
+            out_ += c % 5 == 0 ? "+ " : "- ";
+        }
+    }
+    DrawHeader(snap);
+    for (auto r = 0; r < num_row_; r++) {
+        auto omask = snap.omasks[r];
+        auto xmask = snap.xmasks[r];
+        auto* line = &screen_[r * num_col_];
+        for (auto c = 0; c < num_col_; c++) {
+            auto col_mask = static_cast<BitMask>(1) << c;
+            auto x = omask & col_mask ? o_ : (xmask & col_mask ? x_ : u_);
+            if (line[c] == x) {
+                continue;
+            }
+            line[c] = x;
+            MoveTo(r + 3, c * 2 + 3);
+            out_ += x;
+        }
+    }
+    fputs(out_.c_str(), stdout);
+    fflush(stdout);
+    out_.clear();
+}
+
+void Nono::Renderer::DrawHeader(const Snapshot& snap)
+{
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "===");
+    if (snap.row >= 0) {
+        len += snprintf(buf + len, sizeof(buf) - len, " row %d ", snap.row + 1);
+    }
+    if (snap.col >= 0) {
+        len += snprintf(buf + len, sizeof(buf) - len, " col %d ", snap.col + 1);
+    }
+    snprintf(buf + len, sizeof(buf) - len, "===");
+    MoveTo(1, 1);
+    out_ += "\x1b[2K";  // Erase the previous header.
+    out_ += buf;
+}
+
+// Append the ANSI sequence to move the cursor. 1-based.
+void Nono::Renderer::MoveTo(int line, int column)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", line, column);
+    out_ += buf;
+}
+
+void Nono::SetBudget(long long timeout_ms, long long max_nodes)
+{
+    timeout_ms_ = timeout_ms;
+    max_nodes_ = max_nodes;
+}
+
+void Nono::Cancel()
+{
+    cancelled_.store(true, memory_order_relaxed);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Run and test
 ///////////////////////////////////////////////////////////////////////////////
 static bool opt_show_progress = false;
 static bool opt_wait_key = false;
 static bool opt_long_sample = false;
+static long long opt_timeout_ms = DEF_TIMEOUT_MS;
+static long long opt_max_nodes = DEF_MAX_NODES;
+static bool opt_verify = false;
 
-void RunCommon(vector<vector<int>>& rows, vector<vector<int>>& cols)
+enum class OutputFormat {
+    kText,
+    kPacked,  // Hex rows to stdout
+    kPbm,     // <name>.pbm in the current directory
+};
+static OutputFormat opt_output = OutputFormat::kText;
+
+// Write <name>.pbm, where name is the base name of path without extension.
+void WritePbmFile(Nono& nono, const char* path)
+{
+    string name = path;
+    auto slash = name.find_last_of("/\\");
+    if (slash != string::npos) {
+        name = name.substr(slash + 1);
+    }
+    auto dot = name.find_last_of('.');
+    if (dot != string::npos && dot > 0) {
+        name = name.substr(0, dot);
+    }
+    name += ".pbm";
+    FILE* fp = fopen(name.c_str(), "wb");
+    if (fp == NULL) {
+        printf("Cannot open file %s\n", name.c_str());
+        return;
+    }
+    nono.WritePbm(fp);
+    fclose(fp);
+    printf("Wrote %s\n", name.c_str());
+}
+
+// The solve Ctrl-C cancels.
+static atomic<Nono*> running_nono{nullptr};
+
+// Cancel the running solve to show the partial result.
+// Terminate as usual when no solve is running.
+void HandleInterrupt(int sig)
+{
+    auto nono = running_nono.load();
+    if (nono != nullptr) {
+        nono->Cancel();
+        return;
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Returns true if solved, and verified with -v.
+bool RunCommon(vector<vector<int>>& rows, vector<vector<int>>& cols, const char* name)
 {
     auto start = chrono::system_clock::now();
     Nono nono(rows, cols);
     nono.SetOption(opt_show_progress, opt_wait_key);
-    bool success = nono.Solve();
+    nono.SetBudget(opt_timeout_ms, opt_max_nodes);
+    running_nono.store(&nono);
+    auto status = nono.Solve();
+    running_nono.store(nullptr);
     auto end = chrono::system_clock::now();
-    nono.Show();
+    auto success = status == SolveStatus::kSolved;
+    if (success && opt_verify) {
+        success = nono.Verify();
+    }
+    // The compact formats cannot tell undecided points from empty ones.
+    // Write them only for a solution.
+    if (opt_output == OutputFormat::kPacked) {
+        if (success) {
+            nono.WritePacked(stdout);
+        } else {
+            printf("unsolved %d %d\n", static_cast<int>(rows.size()), static_cast<int>(cols.size()));
+        }
+    } else if (opt_output == OutputFormat::kPbm) {
+        if (success) {
+            WritePbmFile(nono, name);
+        } else {
+            printf("No PBM written for unsolved %s\n", name);
+        }
+    } else {
+        nono.Show();
+    }
     if (success) printf("SUCCESS: ");
+    else if (status == SolveStatus::kSolved) printf("INVALID: ");
+    else if (status == SolveStatus::kTimedOut) printf("TIMEOUT: ");
+    else if (status == SolveStatus::kCancelled) printf("CANCELLED: ");
     else printf("FAILURE: ");
     printf("took %lld us.\n", chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    return success;
 }
 
 void RunLongSample()
@@ -562,7 +1096,7 @@ void RunLongSample()
         vector<int>({2, 3, 3, 5}),
         vector<int>({3}),
         });
-    RunCommon(rows, cols);
+    RunCommon(rows, cols, "long_sample");
 }
 
 void RunShortSample()
@@ -591,7 +1125,7 @@ void RunShortSample()
         vector<int>({6}),
         vector<int>({4}),
         });
-    RunCommon(rows, cols);
+    RunCommon(rows, cols, "sample");
 }
 
 void RunSample()
@@ -626,43 +1160,62 @@ vector<vector<int>> BuildLines(FILE* fp, int nlines)
     return result;
 }
 
-void RunFile(const char* filename)
+bool RunFile(const char* filename)
 {
     char buf[16];
     FILE* fp = fopen(filename, "r");
     if (fp == NULL) {
         printf("Cannot open file %s\n", filename);
-        return;
+        return false;
     }
     int nrow, ncol;
     if (fgets(buf, 16, fp) == NULL) {
         printf("Failed to read line from %s\n", filename);
         fclose(fp);
-        return;
+        return false;
     }
     sscanf(buf, "%d %d", &nrow, &ncol);
     printf("%d rows and %d columns\n", nrow, ncol);
     auto rows = BuildLines(fp, nrow);
     if (rows.size() != nrow) {
         fclose(fp);
-        return;
+        return false;
     }
     auto cols = BuildLines(fp, ncol);
     if (cols.size() != ncol) {
         fclose(fp);
-        return;
+        return false;
     }
     fclose(fp);
 
-    RunCommon(rows, cols);
+    return RunCommon(rows, cols, filename);
+}
+
+// Parse a non-negative number for the option c.
+bool ParseCount(char c, const char* str, long long* value)
+{
+    char* end = nullptr;
+    errno = 0;
+    if (str != nullptr && isdigit(static_cast<unsigned char>(str[0]))) {
+        *value = strtoll(str, &end, 10);
+    }
+    if (end == nullptr || *end != '\0' || errno == ERANGE) {
+        printf("Invalid value for -%c: %s\n", c, str != nullptr ? str : "(none)");
+        return false;
+    }
+    return true;
 }
 
-void SetOpt(int argc, const char* argv[])
+// Set options and collect data files.
+// Returns false on an invalid option value.
+bool SetOpt(int argc, const char* argv[], vector<const char*>& files)
 {
     for (auto i = 1; i < argc; i++) {
         auto a = argv[i];
-        if (a[0] != '-')
+        if (a[0] != '-') {
+            files.push_back(a);
             continue;
+        }
         auto l = strlen(a);
         for (auto j = 1; j < l; j++) {
             auto c = a[j];
@@ -672,29 +1225,47 @@ void SetOpt(int argc, const char* argv[])
                 opt_wait_key = true;
             } else if (c == 'l') {
                 opt_long_sample = true;
+            } else if (c == 'v') {
+                opt_verify = true;
+            } else if (c == 'p') {
+                opt_output = OutputFormat::kPacked;
+            } else if (c == 'b') {
+                opt_output = OutputFormat::kPbm;
+            } else if (c == 't' || c == 'n') {
+                // -t<ms> or -t <ms>: wall-clock deadline in milliseconds.
+                // -n<count> or -n <count>: maximum number of recursion nodes.
+                auto value = a + j + 1;
+                if (*value == '\0') {
+                    value = i + 1 < argc ? argv[++i] : nullptr;
+                }
+                if (!ParseCount(c, value, c == 't' ? &opt_timeout_ms : &opt_max_nodes)) {
+                    return false;
+                }
+                break;
             }
         }
     }
-}
-
-const char* GetFilename(int argc, const char* argv[])
-{
-    for (auto i = 1; i < argc; i++) {
-        auto a = argv[i];
-        if (a[0] != '-')
-            return a;
-    }
-    return nullptr;
+    return true;
 }
 
 int main(int argc, const char* argv[])
 {
-    SetOpt(argc, argv);
-    auto name = GetFilename(argc, argv);
-    if (name == nullptr) {
+    vector<const char*> files;
+    if (!SetOpt(argc, argv, files)) {
+        return 1;
+    }
+    signal(SIGINT, HandleInterrupt);
+    // Run every data file given, so that a corpus can be checked at once.
+    int passed = 0;
+    for (auto name : files) {
+        if (RunFile(name))
+            passed++;
+    }
+    int total = static_cast<int>(files.size());
+    if (total == 0) {
         RunSample();
-    } else {
-        RunFile(name);
+    } else if (total > 1) {
+        printf("Passed %d of %d files\n", passed, total);
     }
-    return 0;
+    return passed == total ? 0 : 1;
 }